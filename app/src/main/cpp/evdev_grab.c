@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include "socket_util.h"
 
 #define TAG "evdev_grab"
 
@@ -54,19 +55,10 @@ Java_com_fasa70_bettertouchpad_NativeBridge_closeDevice(JNIEnv *env, jobject thi
     }
 }
 
-/**
- * Create an abstract Unix socket server and return its fd.
- * The helper process will connect to this socket and send evdev/uinput fds.
- * socketName: abstract name (without leading \0)
- */
-JNIEXPORT jint JNICALL
-Java_com_fasa70_bettertouchpad_NativeBridge_createHelperSocket(JNIEnv *env, jobject thiz, jstring socketName) {
-    const char *name = (*env)->GetStringUTFChars(env, socketName, NULL);
-
-    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+int create_abstract_socket(const char *name, int flags, int backlog) {
+    int server_fd = socket(AF_UNIX, SOCK_STREAM | flags, 0);
     if (server_fd < 0) {
         __android_log_print(ANDROID_LOG_ERROR, TAG, "socket() failed: %s", strerror(errno));
-        (*env)->ReleaseStringUTFChars(env, socketName, name);
         return -1;
     }
 
@@ -78,19 +70,30 @@ Java_com_fasa70_bettertouchpad_NativeBridge_createHelperSocket(JNIEnv *env, jobj
     socklen_t addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + strlen(name));
 
     if (bind(server_fd, (struct sockaddr *)&addr, addr_len) < 0) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "bind() failed: %s", strerror(errno));
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "bind(@%s) failed: %s", name, strerror(errno));
         close(server_fd);
-        (*env)->ReleaseStringUTFChars(env, socketName, name);
         return -1;
     }
-    if (listen(server_fd, 1) < 0) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "listen() failed: %s", strerror(errno));
+    if (listen(server_fd, backlog) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "listen(@%s) failed: %s", name, strerror(errno));
         close(server_fd);
-        (*env)->ReleaseStringUTFChars(env, socketName, name);
         return -1;
     }
+    return server_fd;
+}
 
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Helper socket created: @%s fd=%d", name, server_fd);
+/**
+ * Create an abstract Unix socket server and return its fd.
+ * The helper process will connect to this socket and send evdev/uinput fds.
+ * socketName: abstract name (without leading \0)
+ */
+JNIEXPORT jint JNICALL
+Java_com_fasa70_bettertouchpad_NativeBridge_createHelperSocket(JNIEnv *env, jobject thiz, jstring socketName) {
+    const char *name = (*env)->GetStringUTFChars(env, socketName, NULL);
+    int server_fd = create_abstract_socket(name, 0, 1);
+    if (server_fd >= 0) {
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Helper socket created: @%s fd=%d", name, server_fd);
+    }
     (*env)->ReleaseStringUTFChars(env, socketName, name);
     return server_fd;
 }
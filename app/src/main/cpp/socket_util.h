@@ -0,0 +1,10 @@
+#ifndef BETTERTOUCHPAD_SOCKET_UTIL_H
+#define BETTERTOUCHPAD_SOCKET_UTIL_H
+
+/**
+ * Create a listening abstract-namespace Unix stream socket (name without leading \0).
+ * Returns the server fd, or -1 on failure (already logged).
+ */
+int create_abstract_socket(const char *name, int flags, int backlog);
+
+#endif // BETTERTOUCHPAD_SOCKET_UTIL_H
@@ -0,0 +1,29 @@
+#ifndef BETTERTOUCHPAD_STATS_H
+#define BETTERTOUCHPAD_STATS_H
+
+/*
+ * Runtime counters shared by the event loop and the uinput devices, served as a
+ * snapshot over the introspection socket (see touchpad_bridge.c).
+ *
+ * Updates are relaxed atomic adds: no locks and no allocation on the hot path.
+ * Mouse writes can also come from GestureRecognizer's tap timer threads.
+ */
+typedef struct {
+    unsigned long events_read;
+    unsigned long frames_dispatched;
+    unsigned long frames_coalesced;
+    unsigned long syn_dropped;
+    unsigned long poll_wakeups;
+    unsigned long mouse_writes;
+    unsigned long mouse_write_errors;
+    unsigned long touch_writes;
+    unsigned long touch_write_errors;
+} TouchpadStats;
+
+extern TouchpadStats g_stats;
+
+#define STAT_ADD(field, n) __atomic_fetch_add(&g_stats.field, (unsigned long)(n), __ATOMIC_RELAXED)
+#define STAT_INC(field)    STAT_ADD(field, 1)
+#define STAT_GET(field)    __atomic_load_n(&g_stats.field, __ATOMIC_RELAXED)
+
+#endif // BETTERTOUCHPAD_STATS_H
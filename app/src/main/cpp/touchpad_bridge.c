@@ -7,16 +7,30 @@
 #include <linux/input.h>
 #include <android/log.h>
 #include <poll.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "stats.h"
+#include "socket_util.h"
 
 #define TAG "touchpad_bridge"
 #define MAX_SLOTS 10
+#define EVBUF_SIZE 64
+#define STATS_SOCKET_NAME "bettertouchpad_stats"
+#define AID_SHELL 2000
 
 // Globals
 static volatile int g_running = 0;
+static volatile int g_screen_on = 1;
+static int g_wake_fd = -1;          // eventfd: wakes poll() on stop / screen change; kept open
+static int g_stats_fd = -1;         // introspection socket server; open while the loop runs
 static JavaVM *g_jvm = NULL;
 static jobject g_callback_obj = NULL;
 static jmethodID g_on_frame_method = NULL;
 static jmethodID g_on_key_event_method = NULL;
+static jmethodID g_on_cancel_method = NULL;
 
 // Per-slot tracking state
 typedef struct {
@@ -29,6 +43,187 @@ typedef struct {
 static SlotState slots[MAX_SLOTS];
 static int current_slot = 0;
 
+// Counters for the current event loop (see stats.h)
+TouchpadStats g_stats;
+static int64_t loop_start_ns = 0;
+
+// Start of the current screen on/off interval, for per-interval power stats
+static int64_t interval_start_ns = 0;
+static int64_t interval_start_cpu_ns = 0;
+static unsigned long interval_start_wakeups = 0;
+
+// Published by GestureRecognizer on the loop thread when they change
+static int g_gesture_state = 0;
+static char g_settings_desc[1024] = "";
+
+// Mirrors GestureState in GestureRecognizer.kt — keep in the same order
+static const char *const GESTURE_STATE_NAMES[] = {
+    "IDLE", "SINGLE_MOVING", "DRAG", "SCROLL", "EDGE_SWIPE", "THREE_FINGER"
+};
+#define GESTURE_STATE_COUNT (int)(sizeof(GESTURE_STATE_NAMES) / sizeof(GESTURE_STATE_NAMES[0]))
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CPU time of the calling thread; only meaningful on the loop thread
+static int64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void mark_power_interval(void) {
+    interval_start_ns = monotonic_ns();
+    interval_start_cpu_ns = thread_cpu_ns();
+    interval_start_wakeups = STAT_GET(poll_wakeups);
+}
+
+// Log wakeup rate and CPU use for the interval that just ended, then start a new one
+static void log_power_interval(int screen_was_on) {
+    int64_t elapsed = monotonic_ns() - interval_start_ns;
+    int64_t cpu_ns = thread_cpu_ns() - interval_start_cpu_ns;
+    unsigned long wakeups = STAT_GET(poll_wakeups) - interval_start_wakeups;
+    if (elapsed > 0) {
+        double minutes = elapsed / 60e9;
+        double hours   = elapsed / 3600e9;
+        __android_log_print(ANDROID_LOG_INFO, TAG,
+                            "Power (screen %s): %.1f min, wakeups/min=%.1f, cpu ms/hour=%.1f",
+                            screen_was_on ? "on" : "off", minutes, wakeups / minutes, cpu_ns / 1e6 / hours);
+    }
+    mark_power_interval();
+}
+
+static void wake_loop(void) {
+    if (g_wake_fd >= 0) {
+        uint64_t one = 1;
+        write(g_wake_fd, &one, sizeof(one));
+    }
+}
+
+static int any_slot_active(void) {
+    for (int s = 0; s < MAX_SLOTS; s++) {
+        if (slots[s].active) return 1;
+    }
+    return 0;
+}
+
+static void reset_slots(void) {
+    memset(slots, 0, sizeof(slots));
+    for (int s = 0; s < MAX_SLOTS; s++) slots[s].tracking_id = -1;
+}
+
+/*
+ * Rebuild slot state from the kernel after events were drained unparsed (screen off).
+ * The kernel only sends ABS_MT_SLOT on change, so current_slot must come from the
+ * device too. Queued events are discarded first; they predate the snapshot.
+ */
+static void resync_slots(int fd) {
+    struct input_event drain[EVBUF_SIZE];
+    ssize_t nread;
+    while ((nread = read(fd, drain, sizeof(drain))) > 0) {
+        STAT_ADD(events_read, nread / sizeof(struct input_event));
+    }
+
+    reset_slots();
+    current_slot = 0;
+    struct input_absinfo info;
+    if (ioctl(fd, EVIOCGABS(ABS_MT_SLOT), &info) == 0) {
+        current_slot = info.value;
+        if (current_slot < 0) current_slot = 0;
+        if (current_slot >= MAX_SLOTS) current_slot = MAX_SLOTS - 1;
+    }
+
+    struct {
+        uint32_t code;
+        int32_t values[MAX_SLOTS];
+    } req;
+    static const uint32_t codes[] = { ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y };
+    for (int c = 0; c < 3; c++) {
+        memset(&req, 0, sizeof(req));
+        req.code = codes[c];
+        // Devices with fewer slots leave the tail untouched: no finger there
+        if (codes[c] == ABS_MT_TRACKING_ID) {
+            for (int s = 0; s < MAX_SLOTS; s++) req.values[s] = -1;
+        }
+        if (ioctl(fd, EVIOCGMTSLOTS(sizeof(req)), &req) < 0) {
+            __android_log_print(ANDROID_LOG_WARN, TAG, "EVIOCGMTSLOTS failed: %s", strerror(errno));
+            reset_slots();
+            return;
+        }
+        for (int s = 0; s < MAX_SLOTS; s++) {
+            if (codes[c] == ABS_MT_TRACKING_ID) {
+                slots[s].tracking_id = req.values[s];
+                slots[s].active = (req.values[s] != -1) ? 1 : 0;
+            } else if (codes[c] == ABS_MT_POSITION_X) {
+                slots[s].x = req.values[s];
+            } else {
+                slots[s].y = req.values[s];
+            }
+        }
+    }
+}
+
+/*
+ * Answer one introspection client with a key=value snapshot, then close.
+ * Runs on the loop thread between frames, so slot/gesture state is consistent.
+ * Only the app itself, root and adb shell may query.
+ */
+static void serve_stats(void) {
+    int client = accept4(g_stats_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client < 0) return;
+
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0
+        || (cred.uid != getuid() && cred.uid != 0 && cred.uid != AID_SHELL)) {
+        close(client);
+        return;
+    }
+
+    char buf[2048];
+    int active = 0;
+    for (int s = 0; s < MAX_SLOTS; s++) active += slots[s].active;
+    int state = g_gesture_state;
+    int len = snprintf(buf, sizeof(buf),
+            "uptime_ms=%lld\n"
+            "running=%d\n"
+            "screen_on=%d\n"
+            "events_read=%lu\n"
+            "frames_dispatched=%lu\n"
+            "frames_coalesced=%lu\n"
+            "syn_dropped=%lu\n"
+            "poll_wakeups=%lu\n"
+            "mouse_writes=%lu\n"
+            "mouse_write_errors=%lu\n"
+            "touch_writes=%lu\n"
+            "touch_write_errors=%lu\n"
+            "gesture_state=%s\n"
+            "active_slots=%d\n",
+            (long long)((monotonic_ns() - loop_start_ns) / 1000000),
+            g_running, g_screen_on,
+            STAT_GET(events_read), STAT_GET(frames_dispatched), STAT_GET(frames_coalesced),
+            STAT_GET(syn_dropped), STAT_GET(poll_wakeups),
+            STAT_GET(mouse_writes), STAT_GET(mouse_write_errors),
+            STAT_GET(touch_writes), STAT_GET(touch_write_errors),
+            (state >= 0 && state < GESTURE_STATE_COUNT) ? GESTURE_STATE_NAMES[state] : "?",
+            active);
+    for (int s = 0; s < MAX_SLOTS && len < (int)sizeof(buf); s++) {
+        if (!slots[s].active) continue;
+        len += snprintf(buf + len, sizeof(buf) - len, "slot%d=%d@%d,%d\n",
+                        s, slots[s].tracking_id, slots[s].x, slots[s].y);
+    }
+    if (len < (int)sizeof(buf)) {
+        len += snprintf(buf + len, sizeof(buf) - len, "settings=%s\n", g_settings_desc);
+    }
+    if (len > (int)sizeof(buf) - 1) len = (int)sizeof(buf) - 1;
+
+    send(client, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    close(client);
+}
+
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
     g_jvm = vm;
     return JNI_VERSION_1_6;
@@ -45,7 +240,8 @@ Java_com_fasa70_bettertouchpad_NativeBridge_setCallback(JNIEnv *env, jobject thi
     jclass cls = (*env)->GetObjectClass(env, g_callback_obj);
     g_on_frame_method = (*env)->GetMethodID(env, cls, "onFrame", "([I[I[I[II)V");
     g_on_key_event_method = (*env)->GetMethodID(env, cls, "onKeyEvent", "(II)V");
-    if (!g_on_frame_method || !g_on_key_event_method) {
+    g_on_cancel_method = (*env)->GetMethodID(env, cls, "onCancel", "()V");
+    if (!g_on_frame_method || !g_on_key_event_method || !g_on_cancel_method) {
         __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to get callback methods");
     }
 }
@@ -94,6 +290,15 @@ static void dispatch_frame(JNIEnv *env,
     (*env)->DeleteLocalRef(env, jY);
 }
 
+// End the current gesture without tap/click synthesis (processing is pausing)
+static void dispatch_cancel(JNIEnv *env) {
+    if (!g_callback_obj || !g_on_cancel_method) return;
+    (*env)->CallVoidMethod(env, g_callback_obj, g_on_cancel_method);
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionClear(env);
+    }
+}
+
 JNIEXPORT void JNICALL
 Java_com_fasa70_bettertouchpad_NativeBridge_startEventLoop(JNIEnv *env, jobject thiz, jint fd) {
     if (fd < 0) {
@@ -101,27 +306,72 @@ Java_com_fasa70_bettertouchpad_NativeBridge_startEventLoop(JNIEnv *env, jobject
         return;
     }
 
-    memset(slots, 0, sizeof(slots));
-    for (int i = 0; i < MAX_SLOTS; i++) {
-        slots[i].tracking_id = -1;
-        slots[i].active = 0;
-    }
+    reset_slots();
     current_slot = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_gesture_state = 0;
+    loop_start_ns = monotonic_ns();
+    mark_power_interval();
+
+    if (g_wake_fd < 0) {
+        g_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (g_wake_fd < 0) {
+            __android_log_print(ANDROID_LOG_WARN, TAG, "eventfd failed: %s — using 200ms poll", strerror(errno));
+        }
+    } else {
+        uint64_t stale;
+        read(g_wake_fd, &stale, sizeof(stale));
+    }
+    if (g_stats_fd < 0) {
+        g_stats_fd = create_abstract_socket(STATS_SOCKET_NAME, SOCK_NONBLOCK | SOCK_CLOEXEC, 4);
+        if (g_stats_fd >= 0) {
+            __android_log_print(ANDROID_LOG_INFO, TAG, "Stats socket: @%s", STATS_SOCKET_NAME);
+        }
+    }
     g_running = 1;
 
-    struct pollfd pfd;
-    pfd.fd = fd;
-    pfd.events = POLLIN;
+    // Negative fds (wake/stats unavailable) are ignored by poll()
+    struct pollfd pfds[3];
+    pfds[0].fd = fd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = g_wake_fd;
+    pfds[1].events = POLLIN;
+    pfds[2].fd = g_stats_fd;
+    pfds[2].events = POLLIN;
 
     int frame_key_codes[16];
     int frame_key_vals[16];
     int frame_key_count = 0;
     int consecutive_errors = 0;
+    int screen_was_on = g_screen_on;
+    // Classification of the trailing partial frame, carried into the next read() so a
+    // frame split across reads keeps its tracking ID / key events
+    int partial_motion_only = 1;
 
     __android_log_print(ANDROID_LOG_INFO, TAG, "Event loop started fd=%d", fd);
 
     while (g_running) {
-        int ret = poll(&pfd, 1, 200);
+        int screen_on = g_screen_on;
+        if (screen_on != screen_was_on) {
+            log_power_interval(screen_was_on);
+            // Screen off: cancel any gesture (no taps fire), then only drain.
+            // Screen on: slot state went stale while draining — reload it from the kernel.
+            frame_key_count = 0;
+            partial_motion_only = 0;
+            if (!screen_on) {
+                reset_slots();
+                dispatch_cancel(env);
+            } else {
+                resync_slots(fd);
+            }
+            screen_was_on = screen_on;
+        }
+
+        // Idle (no finger down, or screen off): block until the pad or wake fd fires.
+        // Without a wake fd, keep the 200ms tick so g_running is still noticed.
+        int timeout = (g_wake_fd < 0 || (screen_on && any_slot_active())) ? 200 : -1;
+        int ret = poll(pfds, 3, timeout);
+        STAT_INC(poll_wakeups);
         if (ret < 0) {
             if (errno == EINTR) continue;
             __android_log_print(ANDROID_LOG_ERROR, TAG, "poll error: %s", strerror(errno));
@@ -132,14 +382,19 @@ Java_com_fasa70_bettertouchpad_NativeBridge_startEventLoop(JNIEnv *env, jobject
             consecutive_errors = 0;
             continue;
         }
-        if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        if (pfds[1].revents & POLLIN) {
+            uint64_t v;
+            read(g_wake_fd, &v, sizeof(v));
+        }
+        if (pfds[2].revents & POLLIN) serve_stats();
+        if (pfds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) {
             __android_log_print(ANDROID_LOG_ERROR, TAG,
-                                "poll revents error: 0x%x", pfd.revents);
+                                "poll revents error: 0x%x", pfds[0].revents);
             break;
         }
-        if (!(pfd.revents & POLLIN)) continue;
+        if (!(pfds[0].revents & POLLIN)) continue;
 
-        struct input_event evbuf[64];
+        struct input_event evbuf[EVBUF_SIZE];
         ssize_t nread = read(fd, evbuf, sizeof(evbuf));
         if (nread < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -160,6 +415,33 @@ Java_com_fasa70_bettertouchpad_NativeBridge_startEventLoop(JNIEnv *env, jobject
         consecutive_errors = 0;
 
         int n = (int)(nread / sizeof(struct input_event));
+        STAT_ADD(events_read, n);
+
+        // Screen off: drain so the kernel buffer doesn't overflow, but skip all processing.
+        // Uses the state captured this iteration; a change is handled at the top of the loop.
+        if (!screen_on) continue;
+
+        // When we have fallen behind, one read holds several complete frames.
+        // Classify each one: motion-only frames (no key events, no tracking ID
+        // changes, no SYN_DROPPED) that are followed by another motion-only frame
+        // are folded into it, since slot positions are absolute. Frames that add
+        // or lift fingers or carry keys are always delivered on their own.
+        unsigned char frame_motion_only[EVBUF_SIZE];
+        int nframes = 0;
+        int motion_only = partial_motion_only;
+        for (int i = 0; i < n; i++) {
+            struct input_event *e = &evbuf[i];
+            if (e->type == EV_KEY
+                || (e->type == EV_ABS && e->code == ABS_MT_TRACKING_ID)
+                || (e->type == EV_SYN && e->code == SYN_DROPPED)) {
+                motion_only = 0;
+            } else if (e->type == EV_SYN && e->code == SYN_REPORT) {
+                frame_motion_only[nframes++] = (unsigned char)motion_only;
+                motion_only = 1;
+            }
+        }
+        partial_motion_only = motion_only;
+        int frame_idx = 0;
 
         for (int i = 0; i < n; i++) {
             struct input_event *e = &evbuf[i];
@@ -192,24 +474,67 @@ Java_com_fasa70_bettertouchpad_NativeBridge_startEventLoop(JNIEnv *env, jobject
                 }
             } else if (e->type == EV_SYN) {
                 if (e->code == SYN_REPORT) {
+                    int f = frame_idx++;
+                    if (frame_motion_only[f] && f + 1 < nframes && frame_motion_only[f + 1]) {
+                        // A newer motion-only frame is already buffered — skip this one
+                        STAT_INC(frames_coalesced);
+                        continue;
+                    }
                     // Dispatch after we've processed all events up to this SYN_REPORT
                     dispatch_frame(env, frame_key_codes, frame_key_vals, &frame_key_count);
+                    STAT_INC(frames_dispatched);
                 } else if (e->code == SYN_DROPPED) {
                     // Re-sync: clear all slot state
-                    memset(slots, 0, sizeof(slots));
-                    for (int s = 0; s < MAX_SLOTS; s++) slots[s].tracking_id = -1;
+                    reset_slots();
                     frame_key_count = 0;
+                    STAT_INC(syn_dropped);
                     __android_log_print(ANDROID_LOG_WARN, TAG, "SYN_DROPPED — state reset");
                 }
             }
         }
     }
 
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Event loop exited");
+    g_running = 0;
+    // Nothing serves the socket now; close it so clients get ECONNREFUSED instead of hanging
+    if (g_stats_fd >= 0) {
+        close(g_stats_fd);
+        g_stats_fd = -1;
+    }
+    log_power_interval(screen_was_on);
+    __android_log_print(ANDROID_LOG_INFO, TAG, "Event loop exited: frames dispatched=%lu coalesced=%lu",
+                        STAT_GET(frames_dispatched), STAT_GET(frames_coalesced));
 }
 
 JNIEXPORT void JNICALL
 Java_com_fasa70_bettertouchpad_NativeBridge_stopEventLoop(JNIEnv *env, jobject thiz) {
     g_running = 0;
+    wake_loop();
     __android_log_print(ANDROID_LOG_INFO, TAG, "stopEventLoop called");
 }
+
+/**
+ * Display state from the service. While the screen is off the loop only drains the
+ * device and blocks indefinitely between reads; gesture processing is paused.
+ */
+JNIEXPORT void JNICALL
+Java_com_fasa70_bettertouchpad_NativeBridge_setScreenOn(JNIEnv *env, jobject thiz, jboolean on) {
+    if (g_screen_on == (on ? 1 : 0)) return;
+    g_screen_on = on ? 1 : 0;
+    if (g_running) wake_loop();
+}
+
+/** GestureRecognizer reports its GestureState ordinal when it changes (loop thread). */
+JNIEXPORT void JNICALL
+Java_com_fasa70_bettertouchpad_NativeBridge_publishGestureState(JNIEnv *env, jobject thiz, jint state) {
+    g_gesture_state = state;
+}
+
+/** GestureRecognizer reports the settings in effect when they change (loop thread). */
+JNIEXPORT void JNICALL
+Java_com_fasa70_bettertouchpad_NativeBridge_publishSettings(JNIEnv *env, jobject thiz, jstring desc) {
+    const char *s = (*env)->GetStringUTFChars(env, desc, NULL);
+    if (!s) return;
+    strncpy(g_settings_desc, s, sizeof(g_settings_desc) - 1);
+    g_settings_desc[sizeof(g_settings_desc) - 1] = '\0';
+    (*env)->ReleaseStringUTFChars(env, desc, s);
+}
@@ -8,6 +8,7 @@
 #include <android/log.h>
 #include <stdint.h>
 #include <time.h>
+#include "stats.h"
 
 #define TAG "uinput_mouse"
 
@@ -28,7 +29,8 @@ static void emit(int fd, uint16_t type, uint16_t code, int32_t value) {
     ev.type = type;
     ev.code = code;
     ev.value = value;
-    write(fd, &ev, sizeof(ev));
+    if (write(fd, &ev, sizeof(ev)) < 0) STAT_INC(mouse_write_errors);
+    STAT_INC(mouse_writes);
 }
 
 JNIEXPORT jint JNICALL
@@ -7,17 +7,106 @@
 #include <linux/uinput.h>
 #include <android/log.h>
 #include <stdint.h>
+#include <limits.h>
+#include "stats.h"
 
 #define TAG "uinput_touch"
 #define MAX_SLOTS 3
+// Worst case per point: SLOT, TRACKING_ID, X, Y; plus the final SYN_REPORT
+#define MAX_FRAME_EVENTS (MAX_SLOTS * 4 + 1)
 
-static void emit(int fd, uint16_t type, uint16_t code, int32_t value) {
-    struct input_event ev;
-    memset(&ev, 0, sizeof(ev));
-    ev.type = type;
-    ev.code = code;
-    ev.value = value;
-    write(fd, &ev, sizeof(ev));
+/*
+ * Last values emitted to the touch device. MT protocol B keeps per-slot state in
+ * the kernel, so only slots/axes that changed need to be sent; an unchanged frame
+ * is not written at all.
+ */
+typedef struct {
+    int tracking_id; // -1 = no contact, INT_MIN = unknown
+    int x;
+    int y;
+} TouchSlot;
+
+static int cache_fd = -1;
+static int cache_slot = -1;  // last ABS_MT_SLOT emitted, -1 = unknown
+static TouchSlot cache[MAX_SLOTS];
+
+// known: the device is freshly created and has no contacts; otherwise
+// every slot is treated as unknown and fully re-sent on next use.
+static void reset_cache(int fd, int known) {
+    cache_fd = fd;
+    cache_slot = -1;
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        cache[i].tracking_id = known ? -1 : INT_MIN;
+        cache[i].x = INT_MIN;
+        cache[i].y = INT_MIN;
+    }
+}
+
+static void put(struct input_event *buf, int *n, uint16_t type, uint16_t code, int32_t value) {
+    memset(&buf[*n], 0, sizeof(buf[*n]));
+    buf[*n].type  = type;
+    buf[*n].code  = code;
+    buf[*n].value = value;
+    (*n)++;
+}
+
+static void select_slot(struct input_event *buf, int *n, int slot) {
+    if (cache_slot != slot) {
+        put(buf, n, EV_ABS, ABS_MT_SLOT, slot);
+        cache_slot = slot;
+    }
+}
+
+/*
+ * Build the delta frame for `count` points of [slot, x, y, trackingId] into `buf`.
+ * Returns the number of events including SYN_REPORT, or 0 if nothing changed.
+ */
+static int build_frame(int fd, const jint *pts, int count, struct input_event *buf) {
+    if (fd != cache_fd) reset_cache(fd, 0);
+    if (count > MAX_SLOTS) count = MAX_SLOTS;
+
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        int slot = pts[i * 4 + 0];
+        int x    = pts[i * 4 + 1];
+        int y    = pts[i * 4 + 2];
+        int tid  = pts[i * 4 + 3];
+        if (slot < 0 || slot >= MAX_SLOTS) continue;
+        TouchSlot *c = &cache[slot];
+
+        if (tid != c->tracking_id) {
+            select_slot(buf, &n, slot);
+            put(buf, &n, EV_ABS, ABS_MT_TRACKING_ID, tid);
+            c->tracking_id = tid;
+            // New contact: positions must be sent even if they match the old ones
+            c->x = INT_MIN;
+            c->y = INT_MIN;
+        }
+        if (tid < 0) continue;
+        if (x != c->x) {
+            select_slot(buf, &n, slot);
+            put(buf, &n, EV_ABS, ABS_MT_POSITION_X, x);
+            c->x = x;
+        }
+        if (y != c->y) {
+            select_slot(buf, &n, slot);
+            put(buf, &n, EV_ABS, ABS_MT_POSITION_Y, y);
+            c->y = y;
+        }
+    }
+    if (n == 0) return 0;
+    put(buf, &n, EV_SYN, SYN_REPORT, 0);
+    return n;
+}
+
+static void write_frame(int fd, const struct input_event *buf, int n) {
+    if (n <= 0) return;
+    STAT_INC(touch_writes);
+    if (write(fd, buf, sizeof(buf[0]) * n) < 0) {
+        STAT_INC(touch_write_errors);
+        // Kernel state is unknown now; resend everything next frame
+        reset_cache(fd, 0);
+    }
 }
 
 JNIEXPORT jint JNICALL
@@ -91,41 +180,60 @@ Java_com_fasa70_bettertouchpad_NativeBridge_createTouchDevice(JNIEnv *env, jobje
     }
 
     usleep(100000);
+    reset_cache(fd, 1);
     __android_log_print(ANDROID_LOG_INFO, TAG, "Touch device created fd=%d, %dx%d", fd, screen_width, screen_height);
     return fd;
 }
 
 // points: flat array [slot0, x0, y0, trackingId0, slot1, x1, y1, trackingId1, ...]
 // count: number of touch points
+// Only slots/axes that differ from the last emitted values are written.
 JNIEXPORT void JNICALL
 Java_com_fasa70_bettertouchpad_NativeBridge_injectTouch(JNIEnv *env, jobject thiz,
                                                           jint fd, jintArray points, jint count) {
     if (fd < 0 || count <= 0) return;
-    jint *pts = (*env)->GetIntArrayElements(env, points, NULL);
-    for (int i = 0; i < count; i++) {
-        int slot = pts[i * 4 + 0];
-        int x    = pts[i * 4 + 1];
-        int y    = pts[i * 4 + 2];
-        int tid  = pts[i * 4 + 3];
-        emit(fd, EV_ABS, ABS_MT_SLOT, slot);
-        emit(fd, EV_ABS, ABS_MT_TRACKING_ID, tid);
-        if (tid >= 0) {
-            emit(fd, EV_ABS, ABS_MT_POSITION_X, x);
-            emit(fd, EV_ABS, ABS_MT_POSITION_Y, y);
-        }
+    struct input_event buf[MAX_FRAME_EVENTS];
+    // Critical access avoids copying the array; the frame is built, not written, inside it
+    jint *pts = (*env)->GetPrimitiveArrayCritical(env, points, NULL);
+    if (!pts) return;
+    int n = build_frame(fd, pts, count, buf);
+    (*env)->ReleasePrimitiveArrayCritical(env, points, pts, JNI_ABORT);
+    write_frame(fd, buf, n);
+}
+
+// Same as injectTouch, but points live in a direct ByteBuffer (native byte order)
+// that the caller reuses across frames.
+JNIEXPORT void JNICALL
+Java_com_fasa70_bettertouchpad_NativeBridge_injectTouchDirect(JNIEnv *env, jobject thiz,
+                                                                jint fd, jobject buffer, jint count) {
+    if (fd < 0 || count <= 0) return;
+    const jint *pts = (*env)->GetDirectBufferAddress(env, buffer);
+    jlong capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+    if (!pts || capacity < (jlong)count * 4 * (jlong)sizeof(jint)) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "injectTouchDirect: bad buffer for %d points", count);
+        return;
     }
-    emit(fd, EV_SYN, SYN_REPORT, 0);
-    (*env)->ReleaseIntArrayElements(env, points, pts, JNI_ABORT);
+    struct input_event buf[MAX_FRAME_EVENTS];
+    int n = build_frame(fd, pts, count, buf);
+    write_frame(fd, buf, n);
 }
 
 JNIEXPORT void JNICALL
 Java_com_fasa70_bettertouchpad_NativeBridge_releaseAllTouches(JNIEnv *env, jobject thiz, jint fd, jint count) {
     if (fd < 0) return;
+    if (fd != cache_fd) reset_cache(fd, 0);
+    if (count > MAX_SLOTS) count = MAX_SLOTS;
+    struct input_event buf[MAX_FRAME_EVENTS];
+    int n = 0;
     for (int i = 0; i < count; i++) {
-        emit(fd, EV_ABS, ABS_MT_SLOT, i);
-        emit(fd, EV_ABS, ABS_MT_TRACKING_ID, -1);
+        if (cache[i].tracking_id == -1) continue;  // already lifted
+        select_slot(buf, &n, i);
+        put(buf, &n, EV_ABS, ABS_MT_TRACKING_ID, -1);
+        cache[i].tracking_id = -1;
     }
-    emit(fd, EV_SYN, SYN_REPORT, 0);
+    if (n == 0) return;
+    put(buf, &n, EV_SYN, SYN_REPORT, 0);
+    write_frame(fd, buf, n);
 }
 
 JNIEXPORT void JNICALL
@@ -133,6 +241,7 @@ Java_com_fasa70_bettertouchpad_NativeBridge_destroyTouchDevice(JNIEnv *env, jobj
     if (fd < 0) return;
     ioctl(fd, UI_DEV_DESTROY);
     close(fd);
+    if (fd == cache_fd) reset_cache(-1, 0);
     __android_log_print(ANDROID_LOG_INFO, TAG, "Touch device destroyed fd=%d", fd);
 }
 
@@ -1,5 +1,7 @@
 package com.fasa70.bettertouchpad
 
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import kotlin.math.sqrt
 
 // Linux input key codes
@@ -9,6 +11,7 @@ private const val BTN_RIGHT = 0x111
 private const val TAP_MAX_MS         = 280L
 private const val TAP_MAX_MOVE_PX    = 180
 
+// Order is mirrored by GESTURE_STATE_NAMES in touchpad_bridge.c
 private enum class GestureState {
     IDLE, SINGLE_MOVING, DRAG, SCROLL, EDGE_SWIPE, THREE_FINGER
 }
@@ -21,6 +24,7 @@ class GestureRecognizer(
     private val screenHeight: Int
 ) {
     private var state = GestureState.IDLE
+    private var publishedState = GestureState.IDLE
 
     private var prevSlots  = Array(10) { SlotSnapshot(false, -1, 0, 0) }
     private var startSlots = Array(10) { SlotSnapshot(false, -1, 0, 0) }
@@ -56,6 +60,21 @@ class GestureRecognizer(
     private var edgeFixedUiX = 0
     private var edgeFixedUiY = 0
 
+    // Reused native-order buffer of injected points: [slot, x, y, trackingId] * 3
+    private val touchBuf = ByteBuffer.allocateDirect(4 * 3 * Int.SIZE_BYTES).order(ByteOrder.nativeOrder())
+    private val touchPts = touchBuf.asIntBuffer()
+
+    // Pad → uinput transforms, rebuilt only when the settings object changes
+    private var transformSettings: TouchpadSettings? = null
+    private lateinit var edgeTransform: PadTransform
+    private lateinit var threeTransform: PadTransform
+
+    init {
+        // Publish initial state and settings so introspection is current before the first frame
+        NativeBridge.publishGestureState(state.ordinal)
+        updateTransforms(settings.get())
+    }
+
     data class SlotSnapshot(val active: Boolean, val trackingId: Int, val x: Int, val y: Int)
 
     /** Called from JNI on every SYN_REPORT. All arrays have [slotCount] entries. */
@@ -66,6 +85,7 @@ class GestureRecognizer(
     ) {
         val s = settings.get()
         val now = System.currentTimeMillis()
+        updateTransforms(s)
 
         val cur = Array(slotCount) { i ->
             SlotSnapshot(slotActive[i] != 0, trackingIds[i], xs[i], ys[i])
@@ -181,27 +201,15 @@ class GestureRecognizer(
                             edgeRight = bothRight
                             nextTid++
 
-                            // Compute and store the FIXED uinput injection start point now.
+                            // Store the FIXED uinput injection start point now.
                             // The touch slides along display_X (inward from edge),
                             // display_Y is fixed at screen vertical center.
-                            val uinputW = if (s.swapAxes) screenHeight else screenWidth
-                            val uinputH = if (s.swapAxes) screenWidth  else screenHeight
-
-                            // display_X: start at the screen edge (0 for left, screenWidth-1 for right)
-                            var dispX = if (bothRight) {
-                                if (s.invertX) 0 else screenWidth - 1
-                            } else {
-                                if (s.invertX) screenWidth - 1 else 0
-                            }
-                            val dispY = screenHeight / 2
-
-                            // Convert display → uinput
-                            edgeFixedUiX = if (!s.swapAxes) dispX else dispY.coerceIn(0, uinputW - 1)
-                            edgeFixedUiY = if (!s.swapAxes) dispY.coerceIn(0, uinputH - 1) else dispX.coerceIn(0, uinputH - 1)
+                            edgeFixedUiX = edgeTransform.edgeStartX(bothRight)
+                            edgeFixedUiY = edgeTransform.edgeStartY(bothRight)
 
                             // Inject initial touch at fixed start point
-                            val pts = intArrayOf(0, edgeFixedUiX, edgeFixedUiY, nextTid)
-                            NativeBridge.injectTouch(touchFd, pts, 1)
+                            setPoint(0, 0, edgeFixedUiX, edgeFixedUiY, nextTid)
+                            NativeBridge.injectTouchDirect(touchFd, touchBuf, 1)
 
                             state = GestureState.EDGE_SWIPE
                         } else {
@@ -228,32 +236,16 @@ class GestureRecognizer(
 
                     GestureState.EDGE_SWIPE -> {
                         if (p0.active && p1.active && s.edgeSwipe) {
-                            val uinputW = if (s.swapAxes) screenHeight else screenWidth
-                            val uinputH = if (s.swapAxes) screenWidth  else screenHeight
-
-                            // The sliding axis is display_X (inward from edge).
-                            // Compute movement delta along display_X from finger movement on pad_X.
-                            val avgPadX = (c0.x + c1.x) / 2f
-                            val prevAvgPadX = (p0.x + p1.x) / 2f
-                            val deltaPadX = avgPadX - prevAvgPadX
-
-                            // Convert pad_X delta to display_X delta
-                            var dispDx = (deltaPadX / s.padMaxX * screenWidth).toInt()
-                            if (s.invertX) dispDx = -dispDx
-
-                            // Update the current injection position along the sliding axis only
-                            if (!s.swapAxes) {
-                                // uinput_X = display_X (sliding axis)
-                                edgeFixedUiX = (edgeFixedUiX + dispDx).coerceIn(0, uinputW - 1)
-                                // uinput_Y = display_Y — stays fixed
-                            } else {
-                                // uinput_Y = display_X (sliding axis)
-                                edgeFixedUiY = (edgeFixedUiY + dispDx).coerceIn(0, uinputH - 1)
-                                // uinput_X = display_Y — stays fixed
-                            }
-
-                            val pts = intArrayOf(0, edgeFixedUiX, edgeFixedUiY, nextTid)
-                            NativeBridge.injectTouch(touchFd, pts, 1)
+                            // The sliding axis is display_X (inward from edge): only the
+                            // averaged pad_X movement is fed in, display_Y stays fixed.
+                            val sumDx = (c0.x + c1.x) - (p0.x + p1.x)
+                            val nextX = edgeTransform.mapX(edgeFixedUiX, sumDx, 0, sumOfTwo = true)
+                            val nextY = edgeTransform.mapY(edgeFixedUiY, sumDx, 0, sumOfTwo = true)
+                            edgeFixedUiX = nextX
+                            edgeFixedUiY = nextY
+
+                            setPoint(0, 0, edgeFixedUiX, edgeFixedUiY, nextTid)
+                            NativeBridge.injectTouchDirect(touchFd, touchBuf, 1)
                         }
                     }
 
@@ -287,47 +279,29 @@ class GestureRecognizer(
                         threeCentroidPadY = ai.sumOf { cur[it].y } / 3
 
                         if (s.threeFingerMove) {
-                            val uinputW = if (s.swapAxes) screenHeight else screenWidth
-                            val uinputH = if (s.swapAxes) screenWidth  else screenHeight
-                            val pts = IntArray(4 * 3)
+                            val uinputW = threeTransform.uinputW
+                            val uinputH = threeTransform.uinputH
                             for (i in 0..2) {
-                                pts[i*4+0] = i
-                                pts[i*4+1] = uinputW / 2 + (i - 1) * 100
-                                pts[i*4+2] = uinputH / 2
-                                pts[i*4+3] = nextTid + i
+                                setPoint(i, i, uinputW / 2 + (i - 1) * 100, uinputH / 2, nextTid + i)
                             }
-                            NativeBridge.injectTouch(touchFd, pts, 3)
+                            NativeBridge.injectTouchDirect(touchFd, touchBuf, 3)
                         }
                     }
 
                     GestureState.THREE_FINGER -> {
                         if (s.threeFingerMove) {
-                            val uinputW = if (s.swapAxes) screenHeight else screenWidth
-                            val uinputH = if (s.swapAxes) screenWidth  else screenHeight
-
+                            val t = threeTransform
                             val curCentX = threeActiveIdx.sumOf { cur[it].x } / 3
                             val curCentY = threeActiveIdx.sumOf { cur[it].y } / 3
+                            val padDx = curCentX - threeCentroidPadX
+                            val padDy = curCentY - threeCentroidPadY
 
-                            val sp = s.touchInjectSpeed
-                            var dispDx = ((curCentX - threeCentroidPadX).toFloat() / s.padMaxX * screenWidth  * sp).toInt()
-                            var dispDy = ((curCentY - threeCentroidPadY).toFloat() / s.padMaxY * screenHeight * sp).toInt()
-
-                            if (s.invertX) dispDx = -dispDx
-                            if (s.invertY) dispDy = -dispDy
-
-                            val uiDx = if (!s.swapAxes) dispDx else dispDy
-                            val uiDy = if (!s.swapAxes) dispDy else dispDx
-
-                            val pts = IntArray(4 * 3)
                             for (i in 0..2) {
-                                val finalX = (uinputW / 2 + (i - 1) * 100 + uiDx).coerceIn(0, uinputW - 1)
-                                val finalY = (uinputH / 2 + uiDy).coerceIn(0, uinputH - 1)
-                                pts[i*4+0] = i
-                                pts[i*4+1] = finalX
-                                pts[i*4+2] = finalY
-                                pts[i*4+3] = nextTid + i
+                                val finalX = t.mapX(t.uinputW / 2 + (i - 1) * 100, padDx, padDy)
+                                val finalY = t.mapY(t.uinputH / 2, padDx, padDy)
+                                setPoint(i, i, finalX, finalY, nextTid + i)
                             }
-                            NativeBridge.injectTouch(touchFd, pts, 3)
+                            NativeBridge.injectTouchDirect(touchFd, touchBuf, 3)
                         }
                     }
 
@@ -338,6 +312,54 @@ class GestureRecognizer(
 
         // Save current frame as previous
         for (i in cur.indices) prevSlots[i] = cur[i]
+
+        publishState()
+    }
+
+    /**
+     * Called from JNI when event processing pauses (screen off). Ends the current
+     * gesture like a lift, but never synthesizes a tap, right-click or pending click.
+     */
+    @Suppress("unused")
+    fun onCancel() {
+        pendingFirstTap = false
+        pendingTwoFingerTap = false
+        when (state) {
+            GestureState.DRAG -> NativeBridge.sendMouseButton(mouseFd, BTN_LEFT, false)
+            GestureState.EDGE_SWIPE -> NativeBridge.releaseAllTouches(touchFd, 1)
+            GestureState.THREE_FINGER -> NativeBridge.releaseAllTouches(touchFd, 3)
+            else -> {}
+        }
+        state = GestureState.IDLE
+        accX = 0f; accY = 0f
+        scrollAccV = 0f; scrollAccH = 0f
+        trailingAfterScroll = false
+        for (i in prevSlots.indices) prevSlots[i] = SlotSnapshot(false, -1, 0, 0)
+        publishState()
+    }
+
+    private fun publishState() {
+        if (state != publishedState) {
+            NativeBridge.publishGestureState(state.ordinal)
+            publishedState = state
+        }
+    }
+
+    /** Write injected point [i] into [touchBuf]. */
+    private fun setPoint(i: Int, slot: Int, x: Int, y: Int, trackingId: Int) {
+        touchPts.put(i * 4 + 0, slot)
+        touchPts.put(i * 4 + 1, x)
+        touchPts.put(i * 4 + 2, y)
+        touchPts.put(i * 4 + 3, trackingId)
+    }
+
+    /** Rebuild the pad → uinput transforms and republish settings when they have been replaced. */
+    private fun updateTransforms(s: TouchpadSettings) {
+        if (s === transformSettings) return
+        edgeTransform  = PadTransform.create(s, screenWidth, screenHeight, 1f)
+        threeTransform = PadTransform.create(s, screenWidth, screenHeight, s.touchInjectSpeed)
+        transformSettings = s
+        NativeBridge.publishSettings(s.toString())
     }
 
     /** Handle lifting all fingers — decide if it was a tap. */
@@ -1,5 +1,7 @@
 package com.fasa70.bettertouchpad
 
+import java.nio.ByteBuffer
+
 /**
  * JNI bridge to native C code.
  * All methods require root privileges for the open/grab/uinput calls.
@@ -28,6 +30,14 @@ object NativeBridge {
     /** Blocking event loop; returns when stopEventLoop() is called */
     external fun startEventLoop(fd: Int)
     external fun stopEventLoop()
+    /** Display on/off: while off the loop only drains the device and sleeps between reads */
+    external fun setScreenOn(on: Boolean)
+
+    // --- Introspection (served on @bettertouchpad_stats; query with tools/tpstat) ---
+    /** GestureState ordinal; call only when it changes */
+    external fun publishGestureState(state: Int)
+    /** Human-readable settings in effect; call only when they change */
+    external fun publishSettings(desc: String)
 
     // --- Virtual mouse (uinput) ---
     external fun createMouseDevice(): Int
@@ -41,8 +51,10 @@ object NativeBridge {
 
     // --- Virtual touch (uinput) ---
     external fun createTouchDevice(screenWidth: Int, screenHeight: Int): Int
-    /** points: flat array [slot, x, y, trackingId] * count */
+    /** points: flat array [slot, x, y, trackingId] * count; only changed slots/axes are emitted */
     external fun injectTouch(fd: Int, points: IntArray, count: Int)
+    /** Same as [injectTouch], reading points from a reused direct buffer in native byte order */
+    external fun injectTouchDirect(fd: Int, points: ByteBuffer, count: Int)
     external fun releaseAllTouches(fd: Int, count: Int)
     external fun destroyTouchDevice(fd: Int)
 }
@@ -0,0 +1,92 @@
+package com.fasa70.bettertouchpad
+
+import kotlin.math.roundToLong
+
+// Fixed-point fraction bits of the transform matrix (Q16)
+private const val FRAC_BITS = 16
+
+/**
+ * Pad-to-uinput coordinate transform for injected touches.
+ *
+ * Axis swap, X/Y inversion and the pad → screen scale are folded into one Q16 integer
+ * matrix plus a clamp rectangle when settings change, so mapping a point on the hot
+ * path is two multiply-adds and a clamp — no branching on settings, no float math.
+ *
+ *   uiX = originX + (mxx * padDx + mxy * padDy) >> 16
+ *   uiY = originY + (myx * padDx + myy * padDy) >> 16
+ *
+ * Results are truncated toward zero, matching the previous `Float.toInt()` behaviour.
+ */
+class PadTransform private constructor(
+    /** Virtual touch panel size: display size, swapped when swapAxes is enabled */
+    val uinputW: Int,
+    val uinputH: Int,
+    private val mxx: Long, private val mxy: Long,
+    private val myx: Long, private val myy: Long,
+    // Edge-swipe start points in uinput coordinates (left / right physical pad edge)
+    private val edgeLeftX: Int, private val edgeLeftY: Int,
+    private val edgeRightX: Int, private val edgeRightY: Int
+) {
+
+    /** Edge-swipe injection start X for a swipe from the right (or left) pad edge. */
+    fun edgeStartX(fromRight: Boolean): Int = if (fromRight) edgeRightX else edgeLeftX
+
+    /** Edge-swipe injection start Y for a swipe from the right (or left) pad edge. */
+    fun edgeStartY(fromRight: Boolean): Int = if (fromRight) edgeRightY else edgeLeftY
+
+    /**
+     * Map a pad-space delta onto uinput X, offset from [originX] and clamped to the panel.
+     * When [sumOfTwo] is set, [padDx]/[padDy] are sums over two fingers and are averaged.
+     */
+    fun mapX(originX: Int, padDx: Int, padDy: Int, sumOfTwo: Boolean = false): Int =
+        (originX + fixToInt(mxx * padDx + mxy * padDy, sumOfTwo)).coerceIn(0, uinputW - 1)
+
+    /** Y counterpart of [mapX]. */
+    fun mapY(originY: Int, padDx: Int, padDy: Int, sumOfTwo: Boolean = false): Int =
+        (originY + fixToInt(myx * padDx + myy * padDy, sumOfTwo)).coerceIn(0, uinputH - 1)
+
+    private fun fixToInt(v: Long, sumOfTwo: Boolean): Int {
+        val shift = if (sumOfTwo) FRAC_BITS + 1 else FRAC_BITS
+        return if (v >= 0) (v shr shift).toInt() else -((-v) shr shift).toInt()
+    }
+
+    companion object {
+        /**
+         * Build the transform for the given settings and display size.
+         * [speed] scales pad movement (1.0 for edge swipe, touchInjectSpeed for 3-finger).
+         */
+        fun create(s: TouchpadSettings, screenWidth: Int, screenHeight: Int, speed: Float): PadTransform {
+            val uinputW = if (s.swapAxes) screenHeight else screenWidth
+            val uinputH = if (s.swapAxes) screenWidth  else screenHeight
+
+            // Pad delta → display delta, sign carries the inversion
+            val sx = q16(screenWidth.toDouble()  * speed / s.padMaxX) * (if (s.invertX) -1 else 1)
+            val sy = q16(screenHeight.toDouble() * speed / s.padMaxY) * (if (s.invertY) -1 else 1)
+
+            // Display → uinput: identity, or swap of the two axes
+            val mxx = if (s.swapAxes) 0L else sx
+            val mxy = if (s.swapAxes) sy else 0L
+            val myx = if (s.swapAxes) sx else 0L
+            val myy = if (s.swapAxes) 0L else sy
+
+            // Edge swipe starts at the display left/right edge, vertically centred.
+            // With invertX the physical right edge maps to the display left edge.
+            val dispY = screenHeight / 2
+            fun edgeDispX(fromRight: Boolean) =
+                if (fromRight != s.invertX) screenWidth - 1 else 0
+            fun edgeUiX(fromRight: Boolean) =
+                if (!s.swapAxes) edgeDispX(fromRight) else dispY.coerceIn(0, uinputW - 1)
+            fun edgeUiY(fromRight: Boolean) =
+                if (!s.swapAxes) dispY.coerceIn(0, uinputH - 1) else edgeDispX(fromRight).coerceIn(0, uinputH - 1)
+
+            return PadTransform(
+                uinputW, uinputH,
+                mxx, mxy, myx, myy,
+                edgeUiX(false), edgeUiY(false),
+                edgeUiX(true), edgeUiY(true)
+            )
+        }
+
+        private fun q16(v: Double): Long = (v * (1L shl FRAC_BITS)).roundToLong()
+    }
+}
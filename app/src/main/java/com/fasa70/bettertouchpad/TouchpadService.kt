@@ -5,13 +5,18 @@ import android.app.NotificationChannel
 import android.app.NotificationManager
 import android.app.PendingIntent
 import android.app.Service
+import android.content.BroadcastReceiver
+import android.content.Context
 import android.content.Intent
+import android.content.IntentFilter
 import android.os.Build
 import android.os.IBinder
+import android.os.PowerManager
 import android.util.DisplayMetrics
 import android.util.Log
 import android.view.WindowManager
 import androidx.core.app.NotificationCompat
+import androidx.core.content.ContextCompat
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.Job
@@ -23,6 +28,8 @@ private const val TAG = "TouchpadService"
 private const val NOTIFICATION_ID = 1001
 private const val CHANNEL_ID = "touchpad_service"
 private const val SOCKET_NAME = "bettertouchpad_helper"
+// Optional start extra forcing the evdev node (used by tools/loopback); skips auto-detect
+private const val EXTRA_DEVICE_PATH = "devicePath"
 
 class TouchpadService : Service() {
 
@@ -40,10 +47,25 @@ class TouchpadService : Service() {
     private var touchFd   = -1
     private var serverFd  = -1
 
+    // Pause gesture processing while the display is off (native loop only drains the device)
+    private val screenReceiver = object : BroadcastReceiver() {
+        override fun onReceive(context: Context, intent: Intent) {
+            when (intent.action) {
+                Intent.ACTION_SCREEN_OFF -> NativeBridge.setScreenOn(false)
+                Intent.ACTION_SCREEN_ON  -> NativeBridge.setScreenOn(true)
+            }
+        }
+    }
+
     override fun onCreate() {
         super.onCreate()
         settings = SettingsRepository(applicationContext)
         createNotificationChannel()
+        val filter = IntentFilter().apply {
+            addAction(Intent.ACTION_SCREEN_OFF)
+            addAction(Intent.ACTION_SCREEN_ON)
+        }
+        ContextCompat.registerReceiver(this, screenReceiver, filter, ContextCompat.RECEIVER_NOT_EXPORTED)
     }
 
     override fun onStartCommand(intent: Intent?, flags: Int, startId: Int): Int {
@@ -55,11 +77,11 @@ class TouchpadService : Service() {
             return START_NOT_STICKY
         }
         isRunning = true
-        startTouchpadProcessing()
+        startTouchpadProcessing(intent?.getStringExtra(EXTRA_DEVICE_PATH))
         return START_NOT_STICKY
     }
 
-    private fun startTouchpadProcessing() {
+    private fun startTouchpadProcessing(forcedDevicePath: String? = null) {
         eventJob = scope.launch {
             try {
                 val (w, h) = getScreenSize()
@@ -74,7 +96,12 @@ class TouchpadService : Service() {
                 val detectedMaxY: Int
 
                 val s = settings.get()
-                if (s.autoDetectDevice) {
+                if (forcedDevicePath != null) {
+                    evdevPath = forcedDevicePath
+                    detectedMaxX = s.padMaxX
+                    detectedMaxY = s.padMaxY
+                    Log.i(TAG, "Using device path from intent: $evdevPath")
+                } else if (s.autoDetectDevice) {
                     Log.i(TAG, "Auto-detecting touchpad device via getevent -p ...")
                     val detected = detectTouchpadDevice()
                     if (detected != null) {
@@ -211,6 +238,8 @@ class TouchpadService : Service() {
                 NativeBridge.setCallback(recognizer)
 
                 // Step 7: Run blocking event loop
+                val pm = getSystemService(POWER_SERVICE) as PowerManager
+                NativeBridge.setScreenOn(pm.isInteractive)
                 Log.i(TAG, "Starting event loop on evdevFd=$evdevFd")
                 NativeBridge.startEventLoop(evdevFd)
                 Log.i(TAG, "Event loop ended normally")
@@ -345,6 +374,7 @@ class TouchpadService : Service() {
 
     override fun onDestroy() {
         isRunning = false
+        unregisterReceiver(screenReceiver)
         NativeBridge.stopEventLoop()
         eventJob?.cancel()
         cleanup()
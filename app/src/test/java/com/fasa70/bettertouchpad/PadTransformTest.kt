@@ -0,0 +1,163 @@
+package com.fasa70.bettertouchpad
+
+import org.junit.Test
+
+import org.junit.Assert.*
+
+/**
+ * Checks [PadTransform] against the float mapping GestureRecognizer used before the
+ * transform was precomputed, for every swapAxes / invertX / invertY combination.
+ *
+ * The old code truncated float products, so results may differ by at most 1px where
+ * the exact value lands on an integer boundary.
+ */
+class PadTransformTest {
+
+    private val screens = listOf(2560 to 1600, 1600 to 2560, 3048 to 2032, 1080 to 2400)
+    private val speeds  = listOf(1.0f, 0.5f, 1.75f)
+    private val deltas  = listOf(-2879, -1400, -333, -17, -3, -1, 0, 1, 2, 5, 64, 911, 1799, 2879)
+
+    private fun allAxisSettings(): List<TouchpadSettings> {
+        val out = mutableListOf<TouchpadSettings>()
+        for (swap in listOf(false, true))
+            for (ix in listOf(false, true))
+                for (iy in listOf(false, true))
+                    out += TouchpadSettings(swapAxes = swap, invertX = ix, invertY = iy)
+        return out
+    }
+
+    // ── Legacy reference (verbatim float logic from GestureRecognizer) ────────
+
+    private fun legacyEdgeStart(s: TouchpadSettings, w: Int, h: Int, bothRight: Boolean): Pair<Int, Int> {
+        val uinputW = if (s.swapAxes) h else w
+        val uinputH = if (s.swapAxes) w else h
+        val dispX = if (bothRight) {
+            if (s.invertX) 0 else w - 1
+        } else {
+            if (s.invertX) w - 1 else 0
+        }
+        val dispY = h / 2
+        val x = if (!s.swapAxes) dispX else dispY.coerceIn(0, uinputW - 1)
+        val y = if (!s.swapAxes) dispY.coerceIn(0, uinputH - 1) else dispX.coerceIn(0, uinputH - 1)
+        return x to y
+    }
+
+    private fun legacyEdgeSlide(
+        s: TouchpadSettings, w: Int, h: Int,
+        uiX: Int, uiY: Int, c0x: Int, c1x: Int, p0x: Int, p1x: Int
+    ): Pair<Int, Int> {
+        val uinputW = if (s.swapAxes) h else w
+        val uinputH = if (s.swapAxes) w else h
+        val deltaPadX = (c0x + c1x) / 2f - (p0x + p1x) / 2f
+        var dispDx = (deltaPadX / s.padMaxX * w).toInt()
+        if (s.invertX) dispDx = -dispDx
+        return if (!s.swapAxes) (uiX + dispDx).coerceIn(0, uinputW - 1) to uiY
+        else uiX to (uiY + dispDx).coerceIn(0, uinputH - 1)
+    }
+
+    private fun legacyThree(s: TouchpadSettings, w: Int, h: Int, sp: Float, i: Int, dx: Int, dy: Int): Pair<Int, Int> {
+        val uinputW = if (s.swapAxes) h else w
+        val uinputH = if (s.swapAxes) w else h
+        var dispDx = (dx.toFloat() / s.padMaxX * w * sp).toInt()
+        var dispDy = (dy.toFloat() / s.padMaxY * h * sp).toInt()
+        if (s.invertX) dispDx = -dispDx
+        if (s.invertY) dispDy = -dispDy
+        val uiDx = if (!s.swapAxes) dispDx else dispDy
+        val uiDy = if (!s.swapAxes) dispDy else dispDx
+        val x = (uinputW / 2 + (i - 1) * 100 + uiDx).coerceIn(0, uinputW - 1)
+        val y = (uinputH / 2 + uiDy).coerceIn(0, uinputH - 1)
+        return x to y
+    }
+
+    private fun assertNear(msg: String, expected: Int, actual: Int) {
+        assertTrue("$msg: expected $expected got $actual", kotlin.math.abs(expected - actual) <= 1)
+    }
+
+    // ── Tests ───────────────────────────────────────────────────────────────
+
+    @Test
+    fun uinputSize_followsSwapAxes() {
+        for (s in allAxisSettings()) {
+            val t = PadTransform.create(s, 2560, 1600, 1f)
+            assertEquals(if (s.swapAxes) 1600 else 2560, t.uinputW)
+            assertEquals(if (s.swapAxes) 2560 else 1600, t.uinputH)
+        }
+    }
+
+    @Test
+    fun edgeStart_matchesLegacy() {
+        for (s in allAxisSettings()) for ((w, h) in screens) {
+            val t = PadTransform.create(s, w, h, 1f)
+            for (right in listOf(false, true)) {
+                val (ex, ey) = legacyEdgeStart(s, w, h, right)
+                assertEquals("$s ${w}x$h right=$right", ex, t.edgeStartX(right))
+                assertEquals("$s ${w}x$h right=$right", ey, t.edgeStartY(right))
+            }
+        }
+    }
+
+    @Test
+    fun edgeSlide_matchesLegacy() {
+        for (s in allAxisSettings()) for ((w, h) in screens) {
+            val t = PadTransform.create(s, w, h, 1f)
+            for (right in listOf(false, true)) {
+                var x = t.edgeStartX(right); var y = t.edgeStartY(right)
+                var lx = x; var ly = y
+                var p0 = 1400; var p1 = 1450
+                // Alternating odd/even moves exercise the half-pixel two-finger average
+                for (step in listOf(3, -1, 40, 7, -120, 513, -2, 1, 900, -900, 1)) {
+                    val c0 = p0 + step
+                    val c1 = p1 + step / 2
+                    val sumDx = (c0 + c1) - (p0 + p1)
+                    val nx = t.mapX(x, sumDx, 0, sumOfTwo = true)
+                    val ny = t.mapY(y, sumDx, 0, sumOfTwo = true)
+                    val (ex, ey) = legacyEdgeSlide(s, w, h, lx, ly, c0, c1, p0, p1)
+                    assertNear("$s ${w}x$h step=$step x", ex, nx)
+                    assertNear("$s ${w}x$h step=$step y", ey, ny)
+                    x = nx; y = ny
+                    // Keep the reference in lockstep so 1px boundary differences don't accumulate
+                    lx = nx; ly = ny
+                    p0 = c0; p1 = c1
+                }
+            }
+        }
+    }
+
+    @Test
+    fun edgeSlide_onlyMovesSlidingAxis() {
+        for (s in allAxisSettings()) {
+            val t = PadTransform.create(s, 2560, 1600, 1f)
+            val x0 = t.edgeStartX(false); val y0 = t.edgeStartY(false)
+            val x1 = t.mapX(x0, 600, 0, sumOfTwo = true)
+            val y1 = t.mapY(y0, 600, 0, sumOfTwo = true)
+            if (s.swapAxes) assertEquals(x0, x1) else assertEquals(y0, y1)
+        }
+    }
+
+    @Test
+    fun threeFinger_matchesLegacy() {
+        for (s in allAxisSettings()) for ((w, h) in screens) for (sp in speeds) {
+            val t = PadTransform.create(s, w, h, sp)
+            for (dx in deltas) for (dy in deltas) for (i in 0..2) {
+                val (ex, ey) = legacyThree(s, w, h, sp, i, dx, dy)
+                val ax = t.mapX(t.uinputW / 2 + (i - 1) * 100, dx, dy)
+                val ay = t.mapY(t.uinputH / 2, dx, dy)
+                assertNear("$s ${w}x$h sp=$sp d=($dx,$dy) i=$i x", ex, ax)
+                assertNear("$s ${w}x$h sp=$sp d=($dx,$dy) i=$i y", ey, ay)
+            }
+        }
+    }
+
+    @Test
+    fun mapping_isClampedToPanel() {
+        for (s in allAxisSettings()) {
+            val t = PadTransform.create(s, 2560, 1600, 3f)
+            for (d in listOf(-100000, 100000)) {
+                val x = t.mapX(t.uinputW / 2, d, d)
+                val y = t.mapY(t.uinputH / 2, d, d)
+                assertTrue(x in 0 until t.uinputW)
+                assertTrue(y in 0 until t.uinputH)
+            }
+        }
+    }
+}
@@ -0,0 +1,618 @@
+/*
+ * loopback_harness — end-to-end correctness and latency test for the evdev → uinput bridge.
+ *
+ * Runs as root on the device (any Linux host with /dev/uinput works if the bridge is
+ * started by hand). It:
+ *   1. creates a synthetic multitouch touchpad through /dev/uinput,
+ *   2. restarts TouchpadService pointed at that node (devicePath intent extra),
+ *   3. opens the "BetterTouchpad Virtual Mouse" / "Virtual Touch" nodes it creates,
+ *   4. plays scripted finger sequences: tap, double-tap drag, two-finger scroll,
+ *      edge swipe and three-finger move,
+ *   5. checks the events that come out and reports end-to-end latency percentiles
+ *      and events per gesture.
+ *
+ * Latency is measured closed-loop per injected motion frame: outputs still in flight are
+ * drained before the frame is written, then we wait for the first output SYN_REPORT
+ * stamped after the write (both CLOCK_MONOTONIC) before injecting the next frame, so each
+ * sample belongs to its own input. A frame with no output within --timeout-ms counts as
+ * a miss and is recorded at the timeout, so a stalled bridge trips the p99 gate.
+ * Taps are checked for correctness only, since their click is deliberately deferred.
+ *
+ * Usage: loopback_harness [--no-start] [--max-x N] [--max-y N]
+ *                         [--frame-ms N] [--timeout-ms N] [--max-p99-ms N]
+ * Exit code: 0 = all gestures passed and p99 within budget, 1 = failure, 2 = setup error.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <poll.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#define SRC_NAME      "BetterTouchpad Loopback Pad"
+#define MOUSE_NAME    "BetterTouchpad Virtual Mouse"
+#define TOUCH_NAME    "BetterTouchpad Virtual Touch"
+#define SERVICE       "com.fasa70.bettertouchpad/.TouchpadService"
+
+#define MAX_FINGERS   5
+#define MAX_SAMPLES   4096
+
+#ifdef input_event_sec
+#define EV_SEC(e)  ((e)->input_event_sec)
+#define EV_USEC(e) ((e)->input_event_usec)
+#else
+#define EV_SEC(e)  ((e)->time.tv_sec)
+#define EV_USEC(e) ((e)->time.tv_usec)
+#endif
+
+typedef struct {
+    int active;
+    int x;
+    int y;
+} Finger;
+
+/* Events observed on the virtual output devices during one gesture */
+typedef struct {
+    int mouse_events;   /* non-SYN events on the virtual mouse */
+    int touch_events;   /* non-SYN events on the virtual touch panel */
+    int btn_left_down;
+    int btn_left_up;
+    int btn_right_down;
+    int rel_motion;     /* REL_X / REL_Y */
+    int wheel_hi_res;   /* REL_WHEEL_HI_RES / REL_HWHEEL_HI_RES */
+    int touch_down;     /* new contacts: slot takes a tracking id it did not have */
+    int touch_up;       /* contacts lifted: ABS_MT_TRACKING_ID == -1 on a live slot */
+    int max_slot;
+} OutputStats;
+
+static int src_fd   = -1;
+static int mouse_fd = -1;
+static int touch_fd = -1;
+
+static int pad_max_x  = 2879;
+static int pad_max_y  = 1799;
+static int frame_ms   = 8;
+static int timeout_ms = 200;
+static int next_tid   = 1;
+
+static Finger cur[MAX_FINGERS];
+static Finger sent[MAX_FINGERS];
+static int    tids[MAX_FINGERS];
+
+/* Latency bookkeeping: one pending injected frame at a time */
+static int64_t inject_us  = 0;
+static int     awaiting   = 0;
+static int     missed     = 0;     /* measured frames with no output within timeout_ms */
+static int     last_measured = 0;  /* previous frame was measured (its output already seen) */
+static int64_t samples[MAX_SAMPLES];
+static int     nsamples   = 0;
+static int64_t all_samples[MAX_SAMPLES];
+static int     nall       = 0;
+
+static OutputStats stats;
+
+/* Output touch panel slot state, to count contacts rather than re-sent ids */
+static int out_slot = 0;
+static int out_tids[MAX_FINGERS] = { -1, -1, -1, -1, -1 };
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ── Synthetic source device ─────────────────────────────────────────────── */
+
+static int abs_setup(int fd, int code, int min, int max) {
+    struct uinput_abs_setup a;
+    memset(&a, 0, sizeof(a));
+    a.code = code;
+    a.absinfo.minimum = min;
+    a.absinfo.maximum = max;
+    return ioctl(fd, UI_ABS_SETUP, &a);
+}
+
+static int create_source(char *node, size_t node_len) {
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        fprintf(stderr, "open /dev/uinput failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
+    ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH);
+    ioctl(fd, UI_SET_KEYBIT, BTN_TOOL_FINGER);
+    ioctl(fd, UI_SET_KEYBIT, BTN_TOOL_DOUBLETAP);
+    ioctl(fd, UI_SET_KEYBIT, BTN_TOOL_TRIPLETAP);
+
+    ioctl(fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd, UI_SET_ABSBIT, ABS_X);
+    ioctl(fd, UI_SET_ABSBIT, ABS_Y);
+    ioctl(fd, UI_SET_ABSBIT, ABS_MT_SLOT);
+    ioctl(fd, UI_SET_ABSBIT, ABS_MT_TRACKING_ID);
+    ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_X);
+    ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_Y);
+
+    ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+    ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_BUTTONPAD);
+
+    abs_setup(fd, ABS_X, 0, pad_max_x);
+    abs_setup(fd, ABS_Y, 0, pad_max_y);
+    abs_setup(fd, ABS_MT_SLOT, 0, MAX_FINGERS - 1);
+    abs_setup(fd, ABS_MT_TRACKING_ID, 0, 65535);
+    abs_setup(fd, ABS_MT_POSITION_X, 0, pad_max_x);
+    abs_setup(fd, ABS_MT_POSITION_Y, 0, pad_max_y);
+
+    struct uinput_setup usetup;
+    memset(&usetup, 0, sizeof(usetup));
+    usetup.id.bustype = BUS_VIRTUAL;
+    usetup.id.vendor  = 0x1234;
+    usetup.id.product = 0x567a;
+    strcpy(usetup.name, SRC_NAME);
+
+    if (ioctl(fd, UI_DEV_SETUP, &usetup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        fprintf(stderr, "uinput source setup failed: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    char sysname[64];
+    if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+        fprintf(stderr, "UI_GET_SYSNAME failed: %s\n", strerror(errno));
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+        return -1;
+    }
+
+    /* /sys/devices/virtual/input/<sysname>/eventN → /dev/input/eventN */
+    char sys_path[128];
+    snprintf(sys_path, sizeof(sys_path), "/sys/devices/virtual/input/%s", sysname);
+    node[0] = '\0';
+    for (int tries = 0; tries < 50 && node[0] == '\0'; tries++) {
+        DIR *d = opendir(sys_path);
+        if (d) {
+            struct dirent *de;
+            while ((de = readdir(d)) != NULL) {
+                if (strncmp(de->d_name, "event", 5) == 0) {
+                    snprintf(node, node_len, "/dev/input/%.32s", de->d_name);
+                    break;
+                }
+            }
+            closedir(d);
+        }
+        if (node[0] == '\0') usleep(20000);
+    }
+    if (node[0] == '\0') {
+        fprintf(stderr, "could not resolve event node for %s\n", sysname);
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void put(struct input_event *buf, int *n, uint16_t type, uint16_t code, int32_t value) {
+    memset(&buf[*n], 0, sizeof(buf[*n]));
+    buf[*n].type  = type;
+    buf[*n].code  = code;
+    buf[*n].value = value;
+    (*n)++;
+}
+
+/* Write the changes between `sent` and `cur` as one protocol-B frame, then SYN_REPORT. */
+static void inject_frame(void) {
+    struct input_event buf[MAX_FINGERS * 4 + 8];
+    int n = 0;
+    int before = 0, after = 0;
+
+    for (int i = 0; i < MAX_FINGERS; i++) {
+        if (sent[i].active) before++;
+        if (cur[i].active) after++;
+        int changed = cur[i].active != sent[i].active
+                   || (cur[i].active && (cur[i].x != sent[i].x || cur[i].y != sent[i].y));
+        if (!changed) continue;
+        put(buf, &n, EV_ABS, ABS_MT_SLOT, i);
+        if (cur[i].active != sent[i].active) {
+            if (cur[i].active) tids[i] = next_tid++ & 0xffff;
+            put(buf, &n, EV_ABS, ABS_MT_TRACKING_ID, cur[i].active ? tids[i] : -1);
+        }
+        if (cur[i].active) {
+            if (cur[i].x != sent[i].x || !sent[i].active) put(buf, &n, EV_ABS, ABS_MT_POSITION_X, cur[i].x);
+            if (cur[i].y != sent[i].y || !sent[i].active) put(buf, &n, EV_ABS, ABS_MT_POSITION_Y, cur[i].y);
+        }
+        sent[i] = cur[i];
+    }
+    if ((before > 0) != (after > 0)) put(buf, &n, EV_KEY, BTN_TOUCH, after > 0);
+    if (before != after) {
+        if (before == 1 || after == 1) put(buf, &n, EV_KEY, BTN_TOOL_FINGER,    after == 1);
+        if (before == 2 || after == 2) put(buf, &n, EV_KEY, BTN_TOOL_DOUBLETAP, after == 2);
+        if (before >= 3 || after >= 3) put(buf, &n, EV_KEY, BTN_TOOL_TRIPLETAP, after >= 3);
+    }
+    for (int i = 0; i < MAX_FINGERS; i++) {
+        if (cur[i].active) {
+            put(buf, &n, EV_ABS, ABS_X, cur[i].x);
+            put(buf, &n, EV_ABS, ABS_Y, cur[i].y);
+            break;
+        }
+    }
+    put(buf, &n, EV_SYN, SYN_REPORT, 0);
+
+    /* Stamp before writing: the bridge may stamp its output before write() returns */
+    inject_us = now_us();
+    if (write(src_fd, buf, sizeof(buf[0]) * n) < 0) {
+        fprintf(stderr, "source write failed: %s\n", strerror(errno));
+    }
+}
+
+/* ── Output capture ─────────────────────────────────────────────────────── */
+
+static int find_node(const char *want, char *node, size_t node_len) {
+    DIR *d = opendir("/dev/input");
+    if (!d) return -1;
+    int best = -1;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, "event", 5) != 0) continue;
+        char path[64];
+        snprintf(path, sizeof(path), "/dev/input/%.32s", de->d_name);
+        int fd = open(path, O_RDONLY | O_NONBLOCK);
+        if (fd < 0) continue;
+        char name[256] = {0};
+        ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+        close(fd);
+        /* Stale devices from earlier runs may linger; take the newest node */
+        int num = atoi(de->d_name + 5);
+        if (strcmp(name, want) == 0 && num > best) {
+            best = num;
+            snprintf(node, node_len, "%s", path);
+        }
+    }
+    closedir(d);
+    return best;
+}
+
+static int open_output(const char *want) {
+    char node[64];
+    for (int tries = 0; tries < 100; tries++) {
+        if (find_node(want, node, sizeof(node)) >= 0) {
+            int fd = open(node, O_RDONLY | O_NONBLOCK);
+            if (fd < 0) break;
+            int clk = CLOCK_MONOTONIC;
+            ioctl(fd, EVIOCSCLOCKID, &clk);
+            printf("output  %-30s %s\n", want, node);
+            return fd;
+        }
+        usleep(100000);
+    }
+    fprintf(stderr, "output device \"%s\" not found\n", want);
+    return -1;
+}
+
+static void handle_output(const struct input_event *e, int is_mouse) {
+    if (e->type == EV_SYN) {
+        if (e->code == SYN_REPORT && awaiting) {
+            int64_t t = (int64_t)EV_SEC(e) * 1000000 + EV_USEC(e);
+            if (t >= inject_us) {
+                if (nsamples < MAX_SAMPLES) samples[nsamples++] = t - inject_us;
+                awaiting = 0;
+            }
+        }
+        return;
+    }
+    if (is_mouse) {
+        stats.mouse_events++;
+        if (e->type == EV_KEY && e->code == BTN_LEFT) {
+            if (e->value) stats.btn_left_down++; else stats.btn_left_up++;
+        } else if (e->type == EV_KEY && e->code == BTN_RIGHT && e->value) {
+            stats.btn_right_down++;
+        } else if (e->type == EV_REL && (e->code == REL_X || e->code == REL_Y)) {
+            stats.rel_motion++;
+        } else if (e->type == EV_REL && (e->code == 0x0b || e->code == 0x0c)) {
+            stats.wheel_hi_res++;   /* REL_WHEEL_HI_RES / REL_HWHEEL_HI_RES */
+        }
+    } else {
+        stats.touch_events++;
+        if (e->type == EV_ABS && e->code == ABS_MT_TRACKING_ID) {
+            if (e->value >= 0 && e->value != out_tids[out_slot]) stats.touch_down++;
+            if (e->value < 0 && out_tids[out_slot] >= 0) stats.touch_up++;
+            out_tids[out_slot] = e->value;
+        } else if (e->type == EV_ABS && e->code == ABS_MT_SLOT) {
+            if (e->value >= 0 && e->value < MAX_FINGERS) out_slot = e->value;
+            if (e->value > stats.max_slot) stats.max_slot = e->value;
+        }
+    }
+}
+
+/*
+ * Read outputs for `ms` milliseconds. With `until_answered`, return as soon as the
+ * awaited frame's output arrives; with `until_quiet`, return once no output has
+ * arrived for `ms` milliseconds (bounded by timeout_ms).
+ */
+static void pump_ex(int ms, int until_answered, int until_quiet) {
+    struct pollfd pfd[2] = {
+        { .fd = mouse_fd, .events = POLLIN },
+        { .fd = touch_fd, .events = POLLIN },
+    };
+    int64_t start = now_us();
+    int64_t deadline = start + (int64_t)ms * 1000;
+    for (;;) {
+        if (until_answered && !awaiting) break;
+        int64_t left = deadline - now_us();
+        if (left <= 0) break;
+        int ret = poll(pfd, 2, (int)((left + 999) / 1000));
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ret == 0) break;
+        if (until_quiet) {
+            int64_t hard = start + (int64_t)timeout_ms * 1000;
+            deadline = now_us() + (int64_t)ms * 1000;
+            if (deadline > hard) deadline = hard;
+        }
+        for (int k = 0; k < 2; k++) {
+            if (!(pfd[k].revents & POLLIN)) continue;
+            struct input_event evbuf[64];
+            ssize_t nread = read(pfd[k].fd, evbuf, sizeof(evbuf));
+            if (nread <= 0) continue;
+            int n = (int)(nread / sizeof(struct input_event));
+            for (int i = 0; i < n; i++) handle_output(&evbuf[i], k == 0);
+        }
+    }
+}
+
+static void pump(int ms) {
+    pump_ex(ms, 0, 0);
+}
+
+/*
+ * Inject the current finger state and hold it for frame_ms. With `measure`, the frame
+ * is timed closed-loop: anything still in flight from unmeasured frames is drained
+ * first, then we wait for this frame's own output before moving on.
+ */
+static void frame(int measure) {
+    if (measure && !last_measured) pump_ex(2 * frame_ms, 0, 1);
+
+    int64_t start = now_us();
+    awaiting = 0;
+    inject_frame();
+    if (measure) {
+        awaiting = 1;
+        pump_ex(timeout_ms, 1, 0);
+        if (awaiting) {
+            /* No output in time: record a censored sample and drain late output so
+             * it is not credited to the next frame */
+            awaiting = 0;
+            missed++;
+            if (nsamples < MAX_SAMPLES) samples[nsamples++] = (int64_t)timeout_ms * 1000;
+            pump_ex(frame_ms, 0, 1);
+        }
+    }
+    last_measured = measure;
+
+    int left_ms = frame_ms - (int)((now_us() - start) / 1000);
+    if (left_ms > 0) pump(left_ms);
+}
+
+/* Move the first `count` fingers by (dx, dy) per frame for `steps` frames. */
+static void stroke(int count, int dx, int dy, int steps) {
+    for (int s = 0; s < steps; s++) {
+        for (int i = 0; i < count; i++) {
+            cur[i].x += dx;
+            cur[i].y += dy;
+        }
+        frame(1);
+    }
+}
+
+static void place(int i, int x, int y) {
+    cur[i].active = 1;
+    cur[i].x = x;
+    cur[i].y = y;
+}
+
+static void lift_all(void) {
+    for (int i = 0; i < MAX_FINGERS; i++) cur[i].active = 0;
+    frame(0);
+}
+
+/* ── Gestures ───────────────────────────────────────────────────────────── */
+
+static void g_tap(void) {
+    place(0, pad_max_x / 2, pad_max_y / 2);
+    frame(0);
+    pump(40);
+    lift_all();
+}
+
+static void g_double_tap_drag(void) {
+    place(0, pad_max_x / 2, pad_max_y / 2);
+    frame(0);
+    pump(40);
+    lift_all();
+    pump(30);
+    place(0, pad_max_x / 2, pad_max_y / 2);
+    frame(0);
+    stroke(1, 12, 6, 30);
+    lift_all();
+}
+
+static void g_two_finger_scroll(void) {
+    place(0, pad_max_x / 2 - 200, pad_max_y / 3);
+    place(1, pad_max_x / 2 + 200, pad_max_y / 3);
+    frame(0);
+    stroke(2, 0, 10, 40);
+    lift_all();
+}
+
+static void g_edge_swipe(void) {
+    int x = pad_max_x - pad_max_x / 40;
+    place(0, x, pad_max_y / 2 - 150);
+    place(1, x, pad_max_y / 2 + 150);
+    frame(0);
+    stroke(2, -15, 0, 40);
+    lift_all();
+}
+
+static void g_three_finger(void) {
+    place(0, pad_max_x / 2 - 300, pad_max_y / 2);
+    place(1, pad_max_x / 2,       pad_max_y / 2);
+    place(2, pad_max_x / 2 + 300, pad_max_y / 2);
+    frame(0);
+    stroke(3, 8, 8, 40);
+    lift_all();
+}
+
+static int check_tap(const OutputStats *o) {
+    return o->btn_left_down == 1 && o->btn_left_up == 1 && o->rel_motion == 0;
+}
+
+static int check_drag(const OutputStats *o) {
+    return o->btn_left_down == 1 && o->btn_left_up == 1 && o->rel_motion > 0;
+}
+
+static int check_scroll(const OutputStats *o) {
+    return o->wheel_hi_res > 0 && o->btn_left_down == 0 && o->rel_motion == 0;
+}
+
+static int check_edge(const OutputStats *o) {
+    return o->touch_down == 1 && o->touch_up == 1 && o->touch_events > 4 && o->mouse_events == 0;
+}
+
+static int check_three(const OutputStats *o) {
+    return o->touch_down == 3 && o->touch_up == 3 && o->max_slot == 2 && o->mouse_events == 0;
+}
+
+typedef struct {
+    const char *name;
+    void (*play)(void);
+    int (*check)(const OutputStats *);
+    int settle_ms;  /* wait after lift for deferred output (tap timer, release) */
+} Gesture;
+
+static const Gesture gestures[] = {
+    { "tap",               g_tap,               check_tap,    400 },
+    { "double-tap drag",   g_double_tap_drag,   check_drag,   300 },
+    { "two-finger scroll", g_two_finger_scroll, check_scroll, 300 },
+    { "edge swipe",        g_edge_swipe,        check_edge,   300 },
+    { "three-finger move", g_three_finger,      check_three,  300 },
+};
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct_ms(int64_t *v, int n, double p) {
+    if (n == 0) return 0.0;
+    int idx = (int)(p / 100.0 * (n - 1) + 0.5);
+    return v[idx] / 1000.0;
+}
+
+int main(int argc, char **argv) {
+    int start_service = 1;
+    double max_p99_ms = 0.0;  /* 0 = no latency gate */
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-start") == 0) start_service = 0;
+        else if (strcmp(argv[i], "--max-x") == 0 && i + 1 < argc) pad_max_x = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-y") == 0 && i + 1 < argc) pad_max_y = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frame-ms") == 0 && i + 1 < argc) frame_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) timeout_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-p99-ms") == 0 && i + 1 < argc) max_p99_ms = atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--no-start] [--max-x N] [--max-y N] [--frame-ms N] "
+                    "[--timeout-ms N] [--max-p99-ms N]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    char src_node[64];
+    src_fd = create_source(src_node, sizeof(src_node));
+    if (src_fd < 0) return 2;
+    printf("source  %-30s %s (%dx%d)\n", SRC_NAME, src_node, pad_max_x, pad_max_y);
+
+    if (start_service) {
+        char cmd[256];
+        system("am start-foreground-service -n " SERVICE " -a STOP >/dev/null 2>&1");
+        sleep(1);
+        snprintf(cmd, sizeof(cmd),
+                 "am start-foreground-service -n " SERVICE " --es devicePath %s >/dev/null 2>&1",
+                 src_node);
+        if (system(cmd) != 0) fprintf(stderr, "warning: could not start service\n");
+    } else {
+        printf("start the bridge on %s, waiting for output devices...\n", src_node);
+    }
+
+    mouse_fd = open_output(MOUSE_NAME);
+    touch_fd = open_output(TOUCH_NAME);
+    if (mouse_fd < 0 || touch_fd < 0) {
+        ioctl(src_fd, UI_DEV_DESTROY);
+        return 2;
+    }
+    /* Give the bridge time to enter its event loop */
+    pump(1500);
+
+    int failures = 0;
+    printf("\n%-18s %-6s %7s %7s %8s %6s %8s %8s %8s\n",
+           "gesture", "result", "mouse", "touch", "frames", "missed", "p50 ms", "p90 ms", "p99 ms");
+
+    for (size_t g = 0; g < sizeof(gestures) / sizeof(gestures[0]); g++) {
+        memset(&stats, 0, sizeof(stats));
+        nsamples = 0;
+        awaiting = 0;
+        int missed_before = missed;
+
+        gestures[g].play();
+        awaiting = 0;
+        pump(gestures[g].settle_ms);
+
+        int ok = gestures[g].check(&stats);
+        if (!ok) failures++;
+
+        qsort(samples, nsamples, sizeof(samples[0]), cmp_i64);
+        printf("%-18s %-6s %7d %7d %8d %6d %8.2f %8.2f %8.2f\n",
+               gestures[g].name, ok ? "PASS" : "FAIL",
+               stats.mouse_events, stats.touch_events, nsamples, missed - missed_before,
+               pct_ms(samples, nsamples, 50), pct_ms(samples, nsamples, 90),
+               pct_ms(samples, nsamples, 99));
+        if (!ok) {
+            printf("    btnL down/up=%d/%d rel=%d wheel=%d touch down/up=%d/%d max_slot=%d\n",
+                   stats.btn_left_down, stats.btn_left_up, stats.rel_motion, stats.wheel_hi_res,
+                   stats.touch_down, stats.touch_up, stats.max_slot);
+        }
+        for (int i = 0; i < nsamples && nall < MAX_SAMPLES; i++) all_samples[nall++] = samples[i];
+    }
+
+    qsort(all_samples, nall, sizeof(all_samples[0]), cmp_i64);
+    double p99 = pct_ms(all_samples, nall, 99);
+    printf("\noverall latency over %d frames (%d missed): p50=%.2f p90=%.2f p99=%.2f max=%.2f ms\n",
+           nall, missed, pct_ms(all_samples, nall, 50), pct_ms(all_samples, nall, 90), p99,
+           pct_ms(all_samples, nall, 100));
+
+    if (max_p99_ms > 0.0 && p99 > max_p99_ms) {
+        printf("latency gate FAILED: p99 %.2f ms > %.2f ms\n", p99, max_p99_ms);
+        failures++;
+    }
+
+    if (start_service) {
+        system("am start-foreground-service -n " SERVICE " -a STOP >/dev/null 2>&1");
+    }
+    close(mouse_fd);
+    close(touch_fd);
+    ioctl(src_fd, UI_DEV_DESTROY);
+    close(src_fd);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Build the loopback harness for the connected device, push it and run it as root.
+# Extra arguments are passed through, e.g.: ./run_loopback.sh --max-p99-ms 8
+#
+# Requires ANDROID_NDK_HOME, adb and a rooted device with the app installed.
+set -e
+
+ABI="${ABI:-arm64-v8a}"
+HERE="$(cd "$(dirname "$0")" && pwd)"
+OUT="$HERE/build-$ABI"
+
+cmake -S "$HERE" -B "$OUT" \
+    -DCMAKE_TOOLCHAIN_FILE="$ANDROID_NDK_HOME/build/cmake/android.toolchain.cmake" \
+    -DANDROID_ABI="$ABI" -DANDROID_PLATFORM=android-28 >/dev/null
+cmake --build "$OUT" >/dev/null
+
+adb push "$OUT/loopback_harness" /data/local/tmp/loopback_harness >/dev/null
+adb shell chmod 755 /data/local/tmp/loopback_harness
+adb shell su -c "/data/local/tmp/loopback_harness $*"
@@ -0,0 +1,188 @@
+/*
+ * tpstat — query and diff BetterTouchpad runtime snapshots.
+ *
+ * The event loop serves a key=value snapshot on the abstract socket
+ * @bettertouchpad_stats (counters, gesture state, active slots, settings).
+ *
+ * Usage:
+ *   tpstat                      print one snapshot
+ *   tpstat -i SECONDS           take two snapshots SECONDS apart and print the diff
+ *   tpstat -d OLD NEW           diff two saved snapshots (e.g. tpstat > a.txt)
+ *
+ * Run as the app user, root or adb shell; other callers are refused by the service.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#define SOCKET_NAME "bettertouchpad_stats"
+#define SNAP_SIZE   4096
+#define MAX_KEYS    64
+#define TIMEOUT_SEC 2   /* connect/recv; a stopped service may still hold the socket */
+
+typedef struct {
+    char *key[MAX_KEYS];
+    char *val[MAX_KEYS];
+    int   n;
+} Snapshot;
+
+static int query(char *buf, size_t size) {
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    struct timeval tv = { .tv_sec = TIMEOUT_SEC, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    /* Abstract namespace: first byte is '\0' */
+    addr.sun_path[0] = '\0';
+    strncpy(addr.sun_path + 1, SOCKET_NAME, sizeof(addr.sun_path) - 2);
+    socklen_t addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + strlen(SOCKET_NAME);
+
+    if (connect(sock, (struct sockaddr *)&addr, addr_len) < 0) {
+        fprintf(stderr, "connect @%s failed: %s (is the service running?)\n",
+                SOCKET_NAME, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    size_t len = 0;
+    for (;;) {
+        ssize_t r = recv(sock, buf + len, size - 1 - len, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            fprintf(stderr, "no reply from @%s within %ds (event loop stopped?)\n",
+                    SOCKET_NAME, TIMEOUT_SEC);
+            close(sock);
+            return -1;
+        }
+        if (r <= 0) break;
+        len += (size_t)r;
+        if (len >= size - 1) break;
+    }
+    buf[len] = '\0';
+    close(sock);
+    if (len == 0) {
+        fprintf(stderr, "empty snapshot (access refused?)\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int read_file(const char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        return -1;
+    }
+    size_t len = fread(buf, 1, size - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    return 0;
+}
+
+/* Split buf in place into key=value lines. */
+static void parse(char *buf, Snapshot *s) {
+    s->n = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(buf, "\n", &save); line && s->n < MAX_KEYS;
+         line = strtok_r(NULL, "\n", &save)) {
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        s->key[s->n] = line;
+        s->val[s->n] = eq + 1;
+        s->n++;
+    }
+}
+
+static const char *lookup(const Snapshot *s, const char *key) {
+    for (int i = 0; i < s->n; i++) {
+        if (strcmp(s->key[i], key) == 0) return s->val[i];
+    }
+    return NULL;
+}
+
+static int is_number(const char *v, long long *out) {
+    char *end;
+    errno = 0;
+    long long x = strtoll(v, &end, 10);
+    if (errno || end == v || *end != '\0') return 0;
+    *out = x;
+    return 1;
+}
+
+/* Print numeric deltas (and per-second rates when the interval is known), and changed text. */
+static void diff(const Snapshot *a, const Snapshot *b) {
+    long long t0, t1;
+    const char *u0 = lookup(a, "uptime_ms"), *u1 = lookup(b, "uptime_ms");
+    double secs = (u0 && u1 && is_number(u0, &t0) && is_number(u1, &t1) && t1 > t0)
+                  ? (t1 - t0) / 1000.0 : 0.0;
+
+    printf("%-20s %14s %14s %12s %10s\n", "key", "old", "new", "delta", "per sec");
+    for (int i = 0; i < b->n; i++) {
+        const char *old = lookup(a, b->key[i]);
+        const char *cur = b->val[i];
+        long long x0, x1;
+        if (old && is_number(old, &x0) && is_number(cur, &x1)) {
+            if (secs > 0.0 && strcmp(b->key[i], "uptime_ms") != 0) {
+                printf("%-20s %14lld %14lld %+12lld %10.1f\n", b->key[i], x0, x1, x1 - x0, (x1 - x0) / secs);
+            } else {
+                printf("%-20s %14lld %14lld %+12lld\n", b->key[i], x0, x1, x1 - x0);
+            }
+        } else if (!old || strcmp(old, cur) != 0) {
+            printf("%-20s %s -> %s\n", b->key[i], old ? old : "(none)", cur);
+        }
+    }
+    /* Keys that disappeared, e.g. a lifted slot */
+    for (int i = 0; i < a->n; i++) {
+        if (!lookup(b, a->key[i])) printf("%-20s %s -> (none)\n", a->key[i], a->val[i]);
+    }
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-i SECONDS | -d OLD NEW]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    static char buf_a[SNAP_SIZE], buf_b[SNAP_SIZE];
+    Snapshot a, b;
+
+    if (argc == 1) {
+        if (query(buf_a, sizeof(buf_a)) < 0) return 1;
+        fputs(buf_a, stdout);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "-i") == 0) {
+        int secs = atoi(argv[2]);
+        if (secs <= 0) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (query(buf_a, sizeof(buf_a)) < 0) return 1;
+        sleep((unsigned)secs);
+        if (query(buf_b, sizeof(buf_b)) < 0) return 1;
+    } else if (argc == 4 && strcmp(argv[1], "-d") == 0) {
+        if (read_file(argv[2], buf_a, sizeof(buf_a)) < 0) return 1;
+        if (read_file(argv[3], buf_b, sizeof(buf_b)) < 0) return 1;
+    } else {
+        usage(argv[0]);
+        return 2;
+    }
+    parse(buf_a, &a);
+    parse(buf_b, &b);
+    diff(&a, &b);
+    return 0;
+}